@@ -1,112 +1,191 @@
 #include "AudioCapture.h"
 
-// Audio capture thread
+// Crossover frequencies between the low, mid and high bands
+#define BAND_LOW_HZ 250
+#define BAND_HIGH_HZ 4000
+
+// A source as seen by the graph
+struct GraphInput {
+	std::unique_ptr<AudioSource> source;
+	size_t available = 0;
+	bool primed = false; // Whether the source has buffered enough to be read at the graph's latency
+	double fill = 0; // Smoothed ring fill level, packets make the raw one jumpy
+};
+
+// A route resolved to the ring it reads from
+struct GraphTap {
+	GraphInput* input;
+	int channel;
+	float gain;
+};
+
+// Audio graph thread, every source captures on its own thread and this one mixes them into the effect inputs
 HRESULT audioCapture(
 	std::atomic_bool* exit,
 	VisualizerOptions* opt
 ) {
-	// Various UUIDs we need to identify things and tell Windows what we want to create and/or work with
-	const CLSID CLSID_MMDeviceEnumerator = __uuidof(MMDeviceEnumerator);
-	const IID IID_IMMDeviceEnumerator = __uuidof(IMMDeviceEnumerator);
-	const IID IID_IAudioClient = __uuidof(IAudioClient);
-	const IID IID_IAudioCaptureClient = __uuidof(IAudioCaptureClient);
-	const IID IID_IAudioRenderClient = __uuidof(IAudioRenderClient);
-
-	CComPtr<IMMDeviceEnumerator> devEnum;
-	CComPtr<IMMDevice> device;
-	IAudioClient* audioClient;
-	IAudioCaptureClient* captureClient;
-	WAVEFORMATEX* deviceFormat;
-	REFERENCE_TIME requestedDuration = REFTIMES_PER_SEC;
-	REFERENCE_TIME actualDuration;
-	UINT32 bufferFrameCount;
-	UINT32 packetLength = 0;
-	bool done = false;
-	BYTE* data;
-	DWORD flags;
-	UINT32 framesAvailable;
+	const UINT64 latency = GRAPH_SAMPLE_RATE * GRAPH_LATENCY_MS / 1000;
+	const float lowCoef = 1 - expf(-2 * 3.14159265f * BAND_LOW_HZ / GRAPH_SAMPLE_RATE);
+	const float highCoef = 1 - expf(-2 * 3.14159265f * BAND_HIGH_HZ / GRAPH_SAMPLE_RATE);
+
+	std::vector<SourceConfig> sources;
+	std::vector<RouteTap> routes[2];
+	{
+		// Take a copy so the console can change the config while we're running, it only applies on restart
+		std::lock_guard<std::mutex> lock(opt->graphMutex);
+		sources = opt->sources;
+		routes[0] = opt->routes[0];
+		routes[1] = opt->routes[1];
+	}
+
+	std::vector<GraphInput> inputs(sources.size());
+	std::vector<GraphTap> taps[2];
+	LevelMeter meters[2];
+	LevelMeter bandMeters[2][3];
+	float lowpass[2][2] = {}; // One-pole lowpass state at each crossover
+	MeterData meter;
+	UINT32 framesSinceUpdate = 0;
+	UINT64 framesDone = 0;
+	FrameExport frameExport;
+	LARGE_INTEGER frequency, start, now;
 
 	HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
 	if (FAILED(hr)) return hr;
 
-	hr = devEnum.CoCreateInstance(CLSID_MMDeviceEnumerator);
-	if (FAILED(hr)) goto Exit;
-
-	// Get the default audio device (presumably the active one? check this later)
-	hr = devEnum->GetDefaultAudioEndpoint(
-		eRender, // This means we're looking for an output device
-		eConsole, // Docs say this doesn't change anything
-		&device // Device interface goes here
-	);
-	if (FAILED(hr)) goto Exit;
-
-	// Get an audio client
-	hr = device->Activate(
-		IID_IAudioClient, // Type of interface we want, there's a fuck ton but AudioLevel uses this one
-		CLSCTX_ALL, // No context restrictions
-		NULL, // This interface type takes no parameters
-		(void**)&audioClient // AC interface goes here, you know the drill by now
-	);
-	if (FAILED(hr)) goto Exit;
-
-	hr = audioClient->GetMixFormat(&deviceFormat);
-	if (FAILED(hr)) goto Exit;
-
-	hr = audioClient->Initialize(
-		AUDCLNT_SHAREMODE_SHARED,
-		AUDCLNT_STREAMFLAGS_LOOPBACK, // Configure the audio stream as a loopback capture stream
-		requestedDuration,
-		0, // Must be 0 for shared mode
-		deviceFormat,
-		NULL // Audio session ID, we don't need this
-	);
-	if (FAILED(hr)) goto Exit;
-
-	hr = audioClient->GetBufferSize(&bufferFrameCount);
-	if (FAILED(hr)) goto Exit;
-
-	hr = audioClient->GetService(
-		IID_IAudioCaptureClient,
-		(void**)&captureClient
-	);
-	if (FAILED(hr)) goto Exit;
-
-	actualDuration = (double)REFTIMES_PER_SEC * bufferFrameCount / deviceFormat->nSamplesPerSec;
-	hr = audioClient->Start(); // Start recording
-	if (FAILED(hr)) goto Exit;
+	// Open every source, a source that fails to open just stays silent
+	for (int i = 0; i < inputs.size(); i++) {
+		inputs[i].source.reset(AudioSource::create(sources[i]));
+		if (!inputs[i].source) continue;
 
-	while (!(*exit)) {
-		Sleep(actualDuration / REFTIMES_PER_MSEC / opt->frequency);
+		HRESULT openResult = inputs[i].source->open();
+		if (FAILED(openResult)) {
+			std::cout << "Failed to open source " << i << " (" << sourceTypeToString(sources[i].type)
+				<< " " << sources[i].target << "), error 0x" << std::hex << openResult << std::dec << std::endl;
+			inputs[i].source.reset();
+		}
+	}
 
-		hr = captureClient->GetNextPacketSize(&packetLength);
-		if (FAILED(hr)) goto Exit;
+	// Resolve routes to the rings they read from
+	for (int c = 0; c < 2; c++) {
+		for (auto& route : routes[c]) {
+			if (route.source < 0 || route.source >= inputs.size()) {
+				std::cout << "Route " << c << ": source " << route.source << " doesn't exist" << std::endl;
+				continue;
+			}
+			if (!inputs[route.source].source) continue; // Already reported when it failed to open
+
+			// Fall back to the last channel the source has, so a mono device still drives both modules
+			int channels = inputs[route.source].source->channels();
+			int channel = route.channel;
+			if (channel < 0 || channel >= channels) {
+				channel = max(0, min(channel, channels - 1));
+				std::cout << "Route " << c << ": source " << route.source << " has no channel " << route.channel
+					<< ", using channel " << channel << " instead" << std::endl;
+			}
+			taps[c].push_back({ &inputs[route.source], channel, route.gain });
+		}
+	}
 
-		while (packetLength != 0) {
-			hr = captureClient->GetBuffer(
-				&data,
-				&framesAvailable,
-				&flags, NULL, NULL
-			);
-			if (FAILED(hr)) goto Exit;
+	// Publish frames for other local tools, not being able to is no reason to stop lighting things up
+	if (opt->exportFrames) {
+		HRESULT exportResult = frameExport.open();
+		if (FAILED(exportResult))
+			std::cout << "Failed to open frame export, error 0x" << std::hex << exportResult << std::dec << std::endl;
+	}
 
-			// Lighting effect
-			opt->effect->effect(opt, framesAvailable, (float*)data);
-			// End of lighting effect
+	for (auto& input : inputs) {
+		if (input.source) input.source->start(exit);
+	}
 
-			hr = captureClient->ReleaseBuffer(framesAvailable);
-			if (FAILED(hr)) goto Exit;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
 
-			hr = captureClient->GetNextPacketSize(&packetLength);
-			if (FAILED(hr)) goto Exit;
+	while (!(*exit)) {
+		Sleep(1000 / opt->frequency);
+
+		// The graph runs on its own clock, GRAPH_LATENCY_MS behind real time to absorb packet jitter
+		QueryPerformanceCounter(&now);
+		UINT64 target = (now.QuadPart - start.QuadPart) * GRAPH_SAMPLE_RATE / frequency.QuadPart;
+		if (target < framesDone + latency) continue;
+		UINT32 frames = (UINT32)(target - latency - framesDone);
+		framesDone += frames;
+
+		// Align every source to the graph clock by nudging its resampling ratio so its ring stays about
+		// GRAPH_LATENCY_MS full. Dropping the excess or reading silence until it's buffered enough again is
+		// only a last resort, for stalls and sources that start or stop delivering.
+		for (auto& input : inputs) {
+			if (!input.source) continue;
+
+			AudioRing* ring = input.source->output();
+			size_t readable = ring->readable();
+			if (readable > frames + 2 * latency) {
+				ring->consume(readable - frames - latency);
+				readable = frames + latency;
+			}
+
+			if (!input.primed) {
+				input.primed = readable >= latency;
+				input.fill = (double)latency;
+			}
+			else if (readable < frames) input.primed = false;
+			input.available = input.primed ? min(readable, (size_t)frames) : 0;
+
+			if (input.primed) {
+				input.fill += 0.02 * ((double)readable - input.fill);
+				float error = (float)((input.fill - latency) / latency);
+				input.source->setRateCorrection(1 + max(-GRAPH_MAX_CORRECTION, min(GRAPH_MAX_CORRECTION, error * GRAPH_MAX_CORRECTION)));
+			}
+		}
+
+		// Pick up window size changes
+		for (int c = 0; c < 2; c++) {
+			if (meters[c].window() != opt->window) meters[c].configure(GRAPH_SAMPLE_RATE, opt->window);
+			for (int b = 0; b < 3; b++) {
+				if (bandMeters[c][b].window() != opt->window) bandMeters[c][b].configure(GRAPH_SAMPLE_RATE, opt->window);
+			}
+		}
+
+		for (UINT32 i = 0; i < frames; i++) {
+			for (int c = 0; c < 2; c++) {
+				float sample = 0;
+				for (auto& tap : taps[c]) {
+					if (i < tap.input->available)
+						sample += tap.input->source->output()->readSlot(i)[tap.channel] * tap.gain;
+				}
+				meters[c].push(sample);
+
+				// Split into bands with a pair of one-pole lowpass filters, cheap and good enough for lighting
+				lowpass[c][0] += lowCoef * (sample - lowpass[c][0]);
+				lowpass[c][1] += highCoef * (sample - lowpass[c][1]);
+				bandMeters[c][0].push(lowpass[c][0]);
+				bandMeters[c][1].push(lowpass[c][1] - lowpass[c][0]);
+				bandMeters[c][2].push(sample - lowpass[c][1]);
+			}
+
+			// Lighting effect, updated at the requested frequency counted in samples so packet size doesn't matter
+			if (++framesSinceUpdate >= GRAPH_SAMPLE_RATE / opt->frequency) {
+				framesSinceUpdate = 0;
+				for (int c = 0; c < 2; c++) {
+					meter.level[c] = meters[c].rms();
+					for (int b = 0; b < 3; b++) meter.bands[c][b] = bandMeters[c][b].rms();
+				}
+				opt->effect->effect(opt, &meter);
+				frameExport.publish(*opt->effect->leds(), meter);
+			}
+			// End of lighting effect
+		}
+
+		for (auto& input : inputs) {
+			if (input.source) input.source->output()->consume(input.available);
 		}
 	}
 
-	hr = audioClient->Stop();
-	if (FAILED(hr)) goto Exit;
+	// Sources have to stop before they're destroyed
+	for (auto& input : inputs) {
+		if (input.source) input.source->join();
+	}
+	inputs.clear();
 
-Exit:
-	SafeRelease(&audioClient);
-	SafeRelease(&captureClient);
 	CoUninitialize();
 	return hr;
 }
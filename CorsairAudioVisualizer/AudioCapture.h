@@ -1,5 +1,8 @@
 #pragma once
 
 #include "LightingEffect.h"
+#include "LevelMeter.h"
+#include "AudioSource.h"
+#include "FrameExport.h"
 
 HRESULT audioCapture(std::atomic_bool*, VisualizerOptions*);
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Utils.h"
+
+// Lock-free single producer, single consumer ring of interleaved float frames. The producer converts
+// samples straight into the slots and commits them, the consumer reads them in place and consumes them,
+// so audio is never copied in or out of the ring.
+class AudioRing {
+	std::vector<float> data;
+	size_t mask;
+	int channels;
+
+	alignas(64) std::atomic<size_t> head{ 0 }; // Only written by the producer
+	alignas(64) std::atomic<size_t> tail{ 0 }; // Only written by the consumer
+
+public:
+	AudioRing(int channels, size_t minFrames)
+		: channels(channels)
+	{
+		size_t frames = 1;
+		while (frames < minFrames) frames <<= 1;
+		mask = frames - 1;
+		data.resize(frames * channels);
+	}
+
+	inline int channelCount() const { return channels; }
+	inline size_t capacity() const { return mask + 1; }
+
+	// Producer side
+	inline size_t writable() const {
+		return capacity() - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+	}
+	inline float* writeSlot(size_t i) {
+		return &data[((head.load(std::memory_order_relaxed) + i) & mask) * channels];
+	}
+	inline void commit(size_t frames) {
+		head.store(head.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+	}
+
+	// Consumer side
+	inline size_t readable() const {
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+	}
+	inline const float* readSlot(size_t i) const {
+		return &data[((tail.load(std::memory_order_relaxed) + i) & mask) * channels];
+	}
+	inline void consume(size_t frames) {
+		tail.store(tail.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+	}
+};
\ No newline at end of file
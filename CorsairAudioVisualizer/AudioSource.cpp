@@ -0,0 +1,75 @@
+#include "AudioSource.h"
+
+static inline float decodeSample(const BYTE* p, const SampleFormat& format) {
+	switch (format.bytesPerSample) {
+	case 2:
+		return *(const INT16*)p / 32768.0f;
+	case 3:
+		return (INT32)((UINT32)p[0] << 8 | (UINT32)p[1] << 16 | (UINT32)p[2] << 24) / 2147483648.0f;
+	default:
+		return format.isFloat ? *(const float*)p : *(const INT32*)p / 2147483648.0f;
+	}
+}
+
+HRESULT AudioSource::setFormat(const WAVEFORMATEX* wfx) {
+	bool isFloat = wfx->wFormatTag == WAVE_FORMAT_IEEE_FLOAT;
+	bool isPCM = wfx->wFormatTag == WAVE_FORMAT_PCM;
+	if (wfx->wFormatTag == WAVE_FORMAT_EXTENSIBLE) {
+		auto ext = (const WAVEFORMATEXTENSIBLE*)wfx;
+		isFloat = IsEqualGUID(ext->SubFormat, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT);
+		isPCM = IsEqualGUID(ext->SubFormat, KSDATAFORMAT_SUBTYPE_PCM);
+	}
+
+	// We handle 32 bit float and 16/24/32 bit integer samples, which covers every shared mode mix format
+	int bytesPerSample = wfx->wBitsPerSample / 8;
+	if (isFloat && bytesPerSample != 4) return E_INVALIDARG;
+	if (isPCM && (bytesPerSample < 2 || bytesPerSample > 4)) return E_INVALIDARG;
+	if (!isFloat && !isPCM) return E_INVALIDARG;
+
+	format = { wfx->nChannels, (int)wfx->nSamplesPerSec, bytesPerSample, wfx->nBlockAlign, isFloat };
+	nominalStep = (double)format.sampleRate / GRAPH_SAMPLE_RATE;
+	phase = 0;
+	previous.assign(format.channels, 0);
+	current.assign(format.channels, 0);
+	ring.reset(new AudioRing(format.channels, GRAPH_SAMPLE_RATE * SOURCE_BUFFER_MS / 1000));
+	return S_OK;
+}
+
+void AudioSource::write(const BYTE* data, UINT32 frames) {
+	size_t space = ring->writable();
+	double step = nominalStep * correction.load(std::memory_order_relaxed);
+	size_t written = 0;
+
+	for (UINT32 f = 0; f < frames; f++) {
+		for (int c = 0; c < format.channels; c++)
+			current[c] = data ? decodeSample(data + f * format.blockAlign + c * format.bytesPerSample, format) : 0;
+
+		// Linear interpolation between the last two input frames, emits every output frame that falls between them
+		while (phase < 1) {
+			if (written < space) {
+				float* out = ring->writeSlot(written++);
+				for (int c = 0; c < format.channels; c++)
+					out[c] = previous[c] + (current[c] - previous[c]) * (float)phase;
+			}
+			phase += step;
+		}
+		phase -= 1;
+		previous.swap(current);
+	}
+
+	// Whatever didn't fit is dropped, the graph only ever falls behind if it's stuck anyway
+	ring->commit(written);
+}
+
+AudioSource* AudioSource::create(const SourceConfig& config) {
+	switch (config.type) {
+	case SourceType::Output:
+		return new EndpointSource(eRender, config.target);
+	case SourceType::Input:
+		return new EndpointSource(eCapture, config.target);
+	case SourceType::File:
+		return new FileSource(config.target);
+	default:
+		return nullptr;
+	}
+}
\ No newline at end of file
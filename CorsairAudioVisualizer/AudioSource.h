@@ -0,0 +1,101 @@
+#pragma once
+
+#include "AudioRing.h"
+
+// Every source is resampled to this rate before it reaches the graph
+#define GRAPH_SAMPLE_RATE 48000
+// How far behind the sources the graph reads, enough to absorb a packet or two of jitter
+#define GRAPH_LATENCY_MS 30
+// Largest resampling ratio correction applied to keep a source in step with the graph clock
+#define GRAPH_MAX_CORRECTION 0.005f
+// How much audio each source can buffer before it starts dropping frames
+#define SOURCE_BUFFER_MS 500
+
+// Sample layout of a device mix format or wave file
+struct SampleFormat {
+	int channels;
+	int sampleRate;
+	int bytesPerSample;
+	int blockAlign;
+	bool isFloat;
+};
+
+// A source of audio for the input graph. Each source runs its own thread that converts whatever it reads
+// to float, resamples it to GRAPH_SAMPLE_RATE and writes it straight into its ring buffer.
+class AudioSource {
+	std::thread thread;
+
+	// Resampler state
+	double nominalStep = 1; // Input frames per output frame at the source's nominal rate
+	std::atomic<float> correction{ 1 }; // Set by the graph to track its clock
+	double phase = 0;
+	std::vector<float> previous;
+	std::vector<float> current;
+
+protected:
+	std::unique_ptr<AudioRing> ring;
+	SampleFormat format{};
+
+	HRESULT setFormat(const WAVEFORMATEX* wfx);
+	// Convert and resample frames into the ring, data can be null for silence
+	void write(const BYTE* data, UINT32 frames);
+	virtual void run(std::atomic_bool* exit) = 0;
+
+public:
+	virtual ~AudioSource() { join(); }
+
+	// Open the device or file, called before start so the graph knows the channel count
+	virtual HRESULT open() = 0;
+
+	inline void start(std::atomic_bool* exit) { thread = std::thread(&AudioSource::run, this, exit); }
+	inline void join() { if (thread.joinable()) thread.join(); }
+
+	inline AudioRing* output() { return ring.get(); }
+	inline int channels() const { return format.channels; }
+	// Scales the resampling ratio, above 1 makes the source produce fewer frames
+	inline void setRateCorrection(float value) { correction.store(value, std::memory_order_relaxed); }
+
+	static AudioSource* create(const SourceConfig& config);
+};
+
+// Captures from a WASAPI endpoint, render endpoints are captured in loopback mode
+class EndpointSource : public AudioSource {
+	EDataFlow flow;
+	std::wstring id;
+
+	CComPtr<IMMDevice> device;
+	IAudioClient* audioClient = NULL;
+	IAudioCaptureClient* captureClient = NULL;
+
+protected:
+	void run(std::atomic_bool* exit);
+
+public:
+	EndpointSource(EDataFlow flow, const std::string& id)
+		: flow(flow), id(id.begin(), id.end())
+	{ }
+	~EndpointSource();
+
+	HRESULT open();
+};
+
+// Plays a wave file in a loop, paced in real time
+class FileSource : public AudioSource {
+	std::string path;
+	std::ifstream file;
+	std::streampos dataStart;
+	UINT32 dataFrames = 0;
+
+protected:
+	void run(std::atomic_bool* exit);
+
+public:
+	FileSource(const std::string& path)
+		: path(path)
+	{ }
+	~FileSource();
+
+	HRESULT open();
+};
+
+HRESULT listEndpoints(std::ostream& out);
\ No newline at end of file
@@ -119,6 +119,13 @@ int processCommand(std::string& cmd, VisualizerOptions& opt, std::ostream& out =
 			opt.multicolor = cmds[2] == "true";
 			return 0;
 		}
+		if (cmds[1] == "export") {
+			// The mapping is opened when the graph starts
+			bool exportFrames = cmds[2] == "true";
+			if (exportFrames == opt.exportFrames) return 0;
+			opt.exportFrames = exportFrames;
+			return 2;
+		}
 		if (cmds[1] == "fall") {
 			opt.fall = std::stof(cmds[2]);
 			return 0;
@@ -127,6 +134,83 @@ int processCommand(std::string& cmd, VisualizerOptions& opt, std::ostream& out =
 			opt.hold = std::stof(cmds[2]);
 			return 0;
 		}
+		if (cmds[1] == "window") {
+			float window = std::stof(cmds[2]);
+			if (!(window >= LEVEL_WINDOW_MIN_MS)) window = LEVEL_WINDOW_MIN_MS; // Also catches NaN
+			opt.window = min(LEVEL_WINDOW_MAX_MS, window);
+			return 0;
+		}
+		// Sources and routes are only read when the graph starts, so changing them restarts it
+		if (cmds[1] == "sources") {
+			int count = std::stoi(cmds[2]);
+			if (count < 0) {
+				out << "Usage: set sources <count>" << std::endl;
+				return 0;
+			}
+
+			std::lock_guard<std::mutex> lock(opt.graphMutex);
+			if (count == opt.sources.size()) return 0;
+			opt.sources.resize(count, { SourceType::None, "" });
+			return 2;
+		}
+		if (cmds[1] == "source") {
+			int index = std::stoi(cmds[2]);
+			if (index < 0 || cmds.size() < 4) {
+				out << "Usage: set source <index> output|input|file|none [device id|path]" << std::endl;
+				return 0;
+			}
+
+			SourceConfig source{ SourceType::None, "" };
+			if (cmds[3] == "output") source.type = SourceType::Output;
+			else if (cmds[3] == "input") source.type = SourceType::Input;
+			else if (cmds[3] == "file") source.type = SourceType::File;
+			else if (cmds[3] != "none") {
+				out << "set source: " << cmds[3] << " is not a valid source type" << std::endl;
+				return 0;
+			}
+
+			// File paths may contain spaces
+			for (int i = 4; i < cmds.size(); i++) source.target += (i > 4 ? " " : "") + cmds[i];
+			if (source.type == SourceType::File && source.target.empty()) {
+				out << "set source: must specify a file" << std::endl;
+				return 0;
+			}
+
+			std::lock_guard<std::mutex> lock(opt.graphMutex);
+			if (index < opt.sources.size() && opt.sources[index] == source) return 0;
+			if (index >= opt.sources.size()) opt.sources.resize(index + 1, { SourceType::None, "" });
+			opt.sources[index] = source;
+			return 2;
+		}
+		if (cmds[1] == "route") {
+			int zone = std::stoi(cmds[2]);
+			if (zone < 0 || zone > 1 || cmds.size() < 4) {
+				out << "Usage: set route <0|1> none|<source>:<channel>[*gain] ..." << std::endl;
+				return 0;
+			}
+
+			std::vector<RouteTap> route;
+			for (int i = 3; i < cmds.size(); i++) {
+				if (cmds[i] == "none") continue;
+
+				size_t colon = cmds[i].find(':');
+				size_t star = cmds[i].find('*');
+				if (colon == std::string::npos) {
+					out << "set route: " << cmds[i] << " is not a valid source channel" << std::endl;
+					return 0;
+				}
+				route.push_back({
+					std::stoi(cmds[i].substr(0, colon)),
+					std::stoi(cmds[i].substr(colon + 1, star - colon - 1)),
+					star == std::string::npos ? 1 : std::stof(cmds[i].substr(star + 1))
+				});
+			}
+
+			std::lock_guard<std::mutex> lock(opt.graphMutex);
+			if (opt.routes[zone] == route) return 0;
+			opt.routes[zone] = route;
+			return 2;
+		}
 		if (cmds[1] == "effect") {
 			if (cmds[2] == BarsEffect::Name) {
 				AudioLightingEffect* newEffect = new BarsEffect(*(opt.effect));
@@ -146,6 +230,22 @@ int processCommand(std::string& cmd, VisualizerOptions& opt, std::ostream& out =
 				opt.effect = newEffect;
 				return 0;
 			}
+			if (cmds[2] == ExpressionEffect::Name) {
+				std::string source;
+				for (int i = 3; i < cmds.size(); i++) source += (i > 3 ? " " : "") + cmds[i];
+
+				Expression expression;
+				std::string error;
+				if (!expression.compile(source, error)) {
+					out << "set effect: " << error << std::endl;
+					return 0;
+				}
+
+				AudioLightingEffect* newEffect = new ExpressionEffect(*(opt.effect), expression, source);
+				delete opt.effect;
+				opt.effect = newEffect;
+				return 0;
+			}
 
 			out << "set effect: " << cmds[2] << " is not a valid effect name" << std::endl;
 			return 0;
@@ -176,12 +276,13 @@ int processCommand(std::string& cmd, VisualizerOptions& opt, std::ostream& out =
 
 		out << "Loading profile " << cmds[1] << "..." << std::endl;
 		std::string line;
+		int result = 0;
 		while (!file.eof()) {
 			std::getline(file, line);
 			line = "set " + line;
-			processCommand(line, opt);
+			if (processCommand(line, opt) == 2) result = 2;
 		}
-		return 0;
+		return result;
 	}
 	if (cmds[0] == "list" || cmds[0] == "ls") {
 		std::vector<std::string> list;
@@ -194,6 +295,10 @@ int processCommand(std::string& cmd, VisualizerOptions& opt, std::ostream& out =
 
 		return 0;
 	}
+	if (cmds[0] == "endpoints") {
+		if (FAILED(listEndpoints(out))) out << "endpoints: failed to list audio devices" << std::endl;
+		return 0;
+	}
 	if (cmds[0] == "help") {
 		std::string file = "help.txt";
 		if (cmds.size() > 1) file = "help_" + cmds[1] + ".txt";
@@ -239,7 +344,12 @@ int main() {
 	// Initialize options
 	Color colors[10];
 	for (int i = 0; i < 10; i++) colors[i] = { 255, 255, 255 };
-	VisualizerOptions opt{ effect, { 0, 0, 0 }, colors, 20, 0, 0, 100, true, true };
+	VisualizerOptions opt{ effect, { 0, 0, 0 }, colors, 20, 0, 0, 20, 100, true, true, true };
+
+	// By default, left and right channels of the default output device drive one module each
+	opt.sources.push_back({ SourceType::Output, "" });
+	opt.routes[0].push_back({ 0, 0, 1 });
+	opt.routes[1].push_back({ 0, 1, 1 });
 
 	std::string def = "load default";
 	processCommand(def, opt);
@@ -5,6 +5,10 @@
 #include <AudioClient.h>
 #include <AudioPolicy.h>
 #include <MMDeviceApi.h>
+#include <Functiondiscoverykeys_devpkey.h>
+#include <mmreg.h>
+#include <ks.h>
+#include <ksmedia.h>
 #include <atlbase.h>
 
 #include <iostream>
@@ -15,4 +19,8 @@
 #include <atomic>
 #include <mutex>
 #include <fstream>
-#include <filesystem>
\ No newline at end of file
+#include <filesystem>
+#include <memory>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
\ No newline at end of file
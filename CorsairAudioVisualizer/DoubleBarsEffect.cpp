@@ -1,15 +1,11 @@
 #include "LightingEffect.h"
 
-void DoubleBarsEffect::effect(VisualizerOptions* opt, UINT32 framesAvailable, float* fdata) {
+void DoubleBarsEffect::effect(VisualizerOptions* opt, MeterData* meter) {
 	float gain = opt->gain;
 
 	// Do this once per channel
 	for (int c = 0; c < 2; c++) {
-		float rms = 0;
-		for (int i = 0; i < framesAvailable * 2; i += 2)
-			rms += fdata[i + c] * fdata[i + c];
-		rms = sqrtf(rms / framesAvailable);
-		float level = rms * gain;
+		float level = meter->level[c] * gain;
 		if (opt->hold > 0) {
 			if (level > hold[c]) {
 				hold[c] = level;
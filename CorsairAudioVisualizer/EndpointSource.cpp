@@ -0,0 +1,141 @@
+#include "AudioSource.h"
+
+// How often the capture thread polls for new packets
+#define ENDPOINT_POLL_MS 5
+
+EndpointSource::~EndpointSource() {
+	join();
+	SafeRelease(&captureClient);
+	SafeRelease(&audioClient);
+}
+
+HRESULT EndpointSource::open() {
+	const CLSID CLSID_MMDeviceEnumerator = __uuidof(MMDeviceEnumerator);
+	const IID IID_IAudioClient = __uuidof(IAudioClient);
+	const IID IID_IAudioCaptureClient = __uuidof(IAudioCaptureClient);
+
+	CComPtr<IMMDeviceEnumerator> devEnum;
+	WAVEFORMATEX* deviceFormat = NULL;
+	REFERENCE_TIME requestedDuration = REFTIMES_PER_SEC;
+
+	HRESULT hr = devEnum.CoCreateInstance(CLSID_MMDeviceEnumerator);
+	if (FAILED(hr)) goto Exit;
+
+	// No ID means the default device for this direction
+	if (id.empty()) hr = devEnum->GetDefaultAudioEndpoint(flow, eConsole, &device);
+	else hr = devEnum->GetDevice(id.c_str(), &device);
+	if (FAILED(hr)) goto Exit;
+
+	hr = device->Activate(IID_IAudioClient, CLSCTX_ALL, NULL, (void**)&audioClient);
+	if (FAILED(hr)) goto Exit;
+
+	hr = audioClient->GetMixFormat(&deviceFormat);
+	if (FAILED(hr)) goto Exit;
+
+	hr = setFormat(deviceFormat);
+	if (FAILED(hr)) goto Exit;
+
+	hr = audioClient->Initialize(
+		AUDCLNT_SHAREMODE_SHARED,
+		flow == eRender ? AUDCLNT_STREAMFLAGS_LOOPBACK : 0, // Output devices are captured as a loopback stream
+		requestedDuration,
+		0, // Must be 0 for shared mode
+		deviceFormat,
+		NULL
+	);
+	if (FAILED(hr)) goto Exit;
+
+	hr = audioClient->GetService(IID_IAudioCaptureClient, (void**)&captureClient);
+
+Exit:
+	CoTaskMemFree(deviceFormat);
+	return hr;
+}
+
+// Capture thread
+void EndpointSource::run(std::atomic_bool* exit) {
+	UINT32 packetLength = 0;
+	BYTE* data;
+	DWORD flags;
+	UINT32 framesAvailable;
+
+	HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+	if (FAILED(hr)) return;
+
+	hr = audioClient->Start();
+	if (FAILED(hr)) goto Exit;
+
+	while (!(*exit)) {
+		Sleep(ENDPOINT_POLL_MS);
+
+		hr = captureClient->GetNextPacketSize(&packetLength);
+		if (FAILED(hr)) goto Exit;
+
+		while (packetLength != 0) {
+			hr = captureClient->GetBuffer(&data, &framesAvailable, &flags, NULL, NULL);
+			if (FAILED(hr)) goto Exit;
+
+			write(flags & AUDCLNT_BUFFERFLAGS_SILENT ? NULL : data, framesAvailable);
+
+			hr = captureClient->ReleaseBuffer(framesAvailable);
+			if (FAILED(hr)) goto Exit;
+
+			hr = captureClient->GetNextPacketSize(&packetLength);
+			if (FAILED(hr)) goto Exit;
+		}
+	}
+
+	audioClient->Stop();
+
+Exit:
+	CoUninitialize();
+}
+
+HRESULT listEndpoints(std::ostream& out) {
+	const CLSID CLSID_MMDeviceEnumerator = __uuidof(MMDeviceEnumerator);
+
+	HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+	if (FAILED(hr)) return hr;
+
+	{
+		CComPtr<IMMDeviceEnumerator> devEnum;
+		hr = devEnum.CoCreateInstance(CLSID_MMDeviceEnumerator);
+		if (FAILED(hr)) goto Exit;
+
+		for (EDataFlow flow : { eRender, eCapture }) {
+			CComPtr<IMMDeviceCollection> collection;
+			UINT count = 0;
+			hr = devEnum->EnumAudioEndpoints(flow, DEVICE_STATE_ACTIVE, &collection);
+			if (FAILED(hr)) goto Exit;
+			hr = collection->GetCount(&count);
+			if (FAILED(hr)) goto Exit;
+
+			out << (flow == eRender ? "Output devices:" : "Input devices:") << std::endl;
+			for (UINT i = 0; i < count; i++) {
+				CComPtr<IMMDevice> device;
+				CComPtr<IPropertyStore> props;
+				LPWSTR id = NULL;
+				PROPVARIANT name;
+				PropVariantInit(&name);
+
+				if (FAILED(collection->Item(i, &device))) continue;
+				if (SUCCEEDED(device->GetId(&id))) {
+					// Endpoint IDs are plain ASCII, names might not be
+					std::string idStr(id, id + wcslen(id));
+					char nameStr[256] = "";
+					if (SUCCEEDED(device->OpenPropertyStore(STGM_READ, &props)) &&
+						SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &name)) && name.pwszVal)
+						WideCharToMultiByte(CP_UTF8, 0, name.pwszVal, -1, nameStr, sizeof(nameStr), NULL, NULL);
+
+					out << "  " << nameStr << "\n    " << idStr << std::endl;
+				}
+				CoTaskMemFree(id);
+				PropVariantClear(&name);
+			}
+		}
+	}
+
+Exit:
+	CoUninitialize();
+	return hr;
+}
\ No newline at end of file
@@ -0,0 +1,367 @@
+#include "Expression.h"
+
+static inline int arity(ExpressionOp op) {
+	switch (op) {
+#define X(name, argc, expr) case ExpressionOp::name: return argc;
+	EXPRESSION_OPS(X)
+#undef X
+	}
+	return 0;
+}
+
+static inline float apply(ExpressionOp op, float a, float b, float c) {
+	switch (op) {
+#define X(name, argc, expr) case ExpressionOp::name: return expr;
+	EXPRESSION_OPS(X)
+#undef X
+	}
+	return 0;
+}
+
+struct NamedInput {
+	const char* name;
+	ExpressionInput input;
+};
+
+static const NamedInput inputNames[] = {
+	{ "level", EI_Level },
+	{ "low", EI_Low },
+	{ "mid", EI_Mid },
+	{ "high", EI_High },
+	{ "index", EI_Index },
+	{ "i", EI_Index },
+	{ "pos", EI_Position },
+	{ "count", EI_Count },
+	{ "time", EI_Time },
+	{ "t", EI_Time },
+	{ "zone", EI_Zone },
+};
+
+struct NamedFunction {
+	const char* name;
+	int argc;
+};
+
+static const NamedFunction functionNames[] = {
+	{ "min", 2 },
+	{ "max", 2 },
+	{ "clamp", 3 },
+	{ "abs", 1 },
+	{ "floor", 1 },
+	{ "fract", 1 },
+	{ "sqrt", 1 },
+	{ "sin", 1 },
+	{ "cos", 1 },
+	{ "pow", 2 },
+	{ "step", 2 },
+	{ "mix", 3 },
+};
+
+// Adds an operation node, or a constant if every argument is constant
+int Expression::node(ExpressionOp op, int a, int b, int c) {
+	int args[3] = { a, b, c };
+	int argc = arity(op);
+
+	bool constant = true;
+	for (int i = 0; i < argc; i++) {
+		if (args[i] < 0) return -1; // Error in a subexpression
+		constant = constant && nodes[args[i]].kind == Node::Constant;
+	}
+
+	// A constant condition picks its branch at compile time
+	if (op == ExpressionOp::Select && nodes[a].kind == Node::Constant) return nodes[a].value != 0 ? b : c;
+
+	if (constant) {
+		float values[3] = { 0, 0, 0 };
+		for (int i = 0; i < argc; i++) values[i] = nodes[args[i]].value;
+		nodes.push_back({ Node::Constant, apply(op, values[0], values[1], values[2]), 0, op, { -1, -1, -1 } });
+	}
+	else nodes.push_back({ Node::Operation, 0, 0, op, { a, b, c } });
+
+	return (int)nodes.size() - 1;
+}
+
+int Expression::fail(const std::string& message) {
+	if (error.empty()) error = message + " at column " + std::to_string(cursor + 1);
+	return -1;
+}
+
+void Expression::skipSpace() {
+	while (cursor < source.size() && isspace((unsigned char)source[cursor])) cursor++;
+}
+
+bool Expression::accept(const char* token) {
+	skipSpace();
+	size_t length = strlen(token);
+	if (source.compare(cursor, length, token) != 0) return false;
+
+	// Don't take '<' out of '<='
+	if (length == 1 && strchr("<>", token[0]) && cursor + 1 < source.size() && source[cursor + 1] == '=') return false;
+
+	cursor += length;
+	return true;
+}
+
+// Every nested parenthesis, call argument and unary operator goes through parseTernary or parseUnary,
+// so counting depth there keeps a pathological profile line from overflowing the stack
+int Expression::parseTernary() {
+	if (++depth > EXPRESSION_MAX_DEPTH) return fail("expression nested too deeply");
+
+	int condition = parseComparison();
+	if (condition < 0 || !accept("?")) {
+		depth--;
+		return condition;
+	}
+
+	int a = parseTernary();
+	if (a < 0) return -1;
+	if (!accept(":")) return fail("expected ':'");
+	int b = parseTernary();
+	if (b < 0) return -1;
+
+	depth--;
+	return node(ExpressionOp::Select, condition, a, b);
+}
+
+int Expression::parseComparison() {
+	int left = parseAdditive();
+	while (left >= 0) {
+		ExpressionOp op;
+		if (accept("<=")) op = ExpressionOp::Le;
+		else if (accept(">=")) op = ExpressionOp::Ge;
+		else if (accept("==")) op = ExpressionOp::Eq;
+		else if (accept("!=")) op = ExpressionOp::Ne;
+		else if (accept("<")) op = ExpressionOp::Lt;
+		else if (accept(">")) op = ExpressionOp::Gt;
+		else break;
+
+		left = node(op, left, parseAdditive());
+	}
+	return left;
+}
+
+int Expression::parseAdditive() {
+	int left = parseTerm();
+	while (left >= 0) {
+		if (accept("+")) left = node(ExpressionOp::Add, left, parseTerm());
+		else if (accept("-")) left = node(ExpressionOp::Sub, left, parseTerm());
+		else break;
+	}
+	return left;
+}
+
+int Expression::parseTerm() {
+	int left = parseUnary();
+	while (left >= 0) {
+		if (accept("*")) left = node(ExpressionOp::Mul, left, parseUnary());
+		else if (accept("/")) left = node(ExpressionOp::Div, left, parseUnary());
+		else if (accept("%")) left = node(ExpressionOp::Mod, left, parseUnary());
+		else break;
+	}
+	return left;
+}
+
+int Expression::parseUnary() {
+	if (++depth > EXPRESSION_MAX_DEPTH) return fail("expression nested too deeply");
+
+	int result;
+	if (accept("-")) result = node(ExpressionOp::Neg, parseUnary());
+	else if (accept("+")) result = parseUnary();
+	else result = parsePower();
+
+	depth--;
+	return result;
+}
+
+int Expression::parsePower() {
+	int base = parsePrimary();
+	if (base >= 0 && accept("^")) return node(ExpressionOp::Pow, base, parseUnary());
+	return base;
+}
+
+int Expression::parsePrimary() {
+	skipSpace();
+	if (cursor >= source.size()) return fail("unexpected end of expression");
+
+	char ch = source[cursor];
+	if (isdigit((unsigned char)ch) || ch == '.') {
+		const char* begin = source.c_str() + cursor;
+		char* end;
+		float value = strtof(begin, &end);
+		if (end == begin) return fail("invalid number");
+
+		cursor += end - begin;
+		nodes.push_back({ Node::Constant, value, 0, ExpressionOp::Add, { -1, -1, -1 } });
+		return (int)nodes.size() - 1;
+	}
+
+	if (isalpha((unsigned char)ch) || ch == '_') {
+		size_t start = cursor;
+		while (cursor < source.size() && (isalnum((unsigned char)source[cursor]) || source[cursor] == '_')) cursor++;
+		std::string name = source.substr(start, cursor - start);
+
+		if (accept("(")) return parseCall(name);
+
+		for (auto& in : inputNames) {
+			if (name == in.name) {
+				nodes.push_back({ Node::Input, 0, in.input, ExpressionOp::Add, { -1, -1, -1 } });
+				return (int)nodes.size() - 1;
+			}
+		}
+		if (name == "pi") {
+			nodes.push_back({ Node::Constant, 3.14159265f, 0, ExpressionOp::Add, { -1, -1, -1 } });
+			return (int)nodes.size() - 1;
+		}
+
+		cursor = start;
+		return fail("unknown name '" + name + "'");
+	}
+
+	if (accept("(")) {
+		int inner = parseTernary();
+		if (inner < 0) return -1;
+		if (!accept(")")) return fail("expected ')'");
+		return inner;
+	}
+
+	return fail(std::string("unexpected '") + ch + "'");
+}
+
+int Expression::parseCall(const std::string& name) {
+	std::vector<int> args;
+	if (!accept(")")) {
+		do {
+			int arg = parseTernary();
+			if (arg < 0) return -1;
+			args.push_back(arg);
+		} while (accept(","));
+		if (!accept(")")) return fail("expected ')'");
+	}
+
+	const NamedFunction* function = nullptr;
+	for (auto& f : functionNames) {
+		if (name == f.name) function = &f;
+	}
+	if (!function) return fail("unknown function '" + name + "'");
+	if (args.size() != function->argc) return fail(name + " takes " + std::to_string(function->argc) + " arguments");
+
+	// Functions without an instruction of their own are expanded into the ones they're made of. Expansions
+	// must not use an argument twice, generate treats the nodes as a tree and would emit it twice.
+	if (name == "min") return node(ExpressionOp::Min, args[0], args[1]);
+	if (name == "max") return node(ExpressionOp::Max, args[0], args[1]);
+	if (name == "clamp") return node(ExpressionOp::Min, node(ExpressionOp::Max, args[0], args[1]), args[2]);
+	if (name == "abs") return node(ExpressionOp::Abs, args[0]);
+	if (name == "floor") return node(ExpressionOp::Floor, args[0]);
+	if (name == "fract") return node(ExpressionOp::Fract, args[0]);
+	if (name == "sqrt") return node(ExpressionOp::Sqrt, args[0]);
+	if (name == "sin") return node(ExpressionOp::Sin, args[0]);
+	if (name == "cos") return node(ExpressionOp::Cos, args[0]);
+	if (name == "pow") return node(ExpressionOp::Pow, args[0], args[1]);
+	if (name == "step") return node(ExpressionOp::Ge, args[1], args[0]);
+	return node(ExpressionOp::Mix, args[0], args[1], args[2]);
+}
+
+// Emits instructions for a node and returns the register holding its value. Temporaries are handed out
+// like a stack, so a node's result reuses the registers its arguments were computed in.
+int Expression::generate(int n, int& top, int& maxTop) {
+	const Node& current = nodes[n];
+	if (current.kind == Node::Input) return current.input;
+	if (current.kind == Node::Constant) return EI_InputCount + current.input;
+
+	int base = top;
+	int args[3] = { 0, 0, 0 }; // Unused arguments read any valid register
+	for (int i = 0; i < arity(current.op); i++) args[i] = generate(current.args[i], top, maxTop);
+
+	top = base;
+	int dst = top++;
+	maxTop = max(maxTop, top);
+	program.push_back({ current.op, (UINT16)dst, (UINT16)args[0], (UINT16)args[1], (UINT16)args[2] });
+	return dst;
+}
+
+bool Expression::compile(const std::string& src, std::string& err) {
+	nodes.clear();
+	program.clear();
+	constants.clear();
+	error.clear();
+	source = src;
+	cursor = 0;
+	depth = 0;
+
+	int root = parseTernary();
+	skipSpace();
+	if (root >= 0 && cursor < source.size()) root = fail(std::string("unexpected '") + source[cursor] + "'");
+	if (root >= 0 && nodes.size() > 0xFFFF - EI_InputCount) root = fail("expression too long");
+	if (root < 0) {
+		err = error;
+		return false;
+	}
+
+	// Walk the tree once without recursing before generating code. Constants that are actually read get a
+	// register each, right after the inputs (constant nodes store their slot in input), and every operation
+	// becomes one instruction, so this also bounds the program size and how deep generate recurses.
+	size_t operations = 0;
+	std::vector<int> pending = { root };
+	while (!pending.empty()) {
+		Node& n = nodes[pending.back()];
+		pending.pop_back();
+
+		if (n.kind == Node::Constant) {
+			auto it = std::find(constants.begin(), constants.end(), n.value);
+			n.input = (int)(it - constants.begin());
+			if (it == constants.end()) constants.push_back(n.value);
+		}
+		else if (n.kind == Node::Operation) {
+			operations++;
+			for (int i = 0; i < arity(n.op); i++) pending.push_back(n.args[i]);
+		}
+	}
+	if (operations > EXPRESSION_MAX_INSTRUCTIONS) {
+		constants.clear();
+		err = "expression too long";
+		return false;
+	}
+
+	int top = EI_InputCount + (int)constants.size();
+	int maxTop = top;
+	result = generate(root, top, maxTop);
+	registerCount = maxTop;
+	laneCount = 0;
+
+	// The tree isn't needed anymore
+	nodes.clear();
+	source.clear();
+	return true;
+}
+
+void Expression::resize(int lanes) {
+	laneCount = lanes;
+	stride = (lanes + 7) & ~7; // Keep every register on its own 32 byte boundary
+	registers.assign((size_t)registerCount * stride, 0);
+	for (int k = 0; k < constants.size(); k++)
+		std::fill_n(&registers[(EI_InputCount + k) * stride], stride, constants[k]);
+}
+
+// Interpreter loop, dispatches once per instruction and runs it over every lane
+const float* Expression::evaluate() {
+	float* r = registers.data();
+	int n = laneCount;
+
+	for (auto& ins : program) {
+		float* d = r + ins.dst * stride;
+		const float* ra = r + ins.a * stride;
+		const float* rb = r + ins.b * stride;
+		const float* rc = r + ins.c * stride;
+
+		switch (ins.op) {
+#define X(name, argc, expr) \
+		case ExpressionOp::name: \
+			for (int i = 0; i < n; i++) { float a = ra[i], b = rb[i], c = rc[i]; d[i] = expr; } \
+			break;
+		EXPRESSION_OPS(X)
+#undef X
+		}
+	}
+
+	return r + result * stride;
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Utils.h"
+
+// Values an expression can read, names are the ones used in expression source
+enum ExpressionInput {
+	EI_Level,    // level: channel level after gain, hold and fall, in LEDs
+	EI_Low,      // low, mid, high: band levels after gain
+	EI_Mid,
+	EI_High,
+	EI_Index,    // index, i: LED index counting from the bottom
+	EI_Position, // pos: LED position from 0 (bottom) to 1 (top)
+	EI_Count,    // count: number of LEDs
+	EI_Time,     // time, t: seconds since the effect was set, wrapping every EXPRESSION_TIME_WRAP seconds
+	EI_Zone,     // zone: 0 or 1
+	EI_InputCount
+};
+
+// Longest program an expression may compile to, keeps a typo in a profile from stalling the graph thread
+#define EXPRESSION_MAX_INSTRUCTIONS 1024
+// Deepest nesting of parentheses, calls and unary operators the parser recurses into
+#define EXPRESSION_MAX_DEPTH 256
+// time wraps around after this many seconds so it keeps full float precision however long we run
+#define EXPRESSION_TIME_WRAP 3600.0
+
+// Operation name, arity and what it computes on lane values a, b and c. Used both to fold constants
+// at compile time and to generate the interpreter loops, so the two can't disagree.
+#define EXPRESSION_OPS(X) \
+	X(Add, 2, a + b) \
+	X(Sub, 2, a - b) \
+	X(Mul, 2, a * b) \
+	X(Div, 2, a / b) \
+	X(Mod, 2, fmodf(a, b)) \
+	X(Pow, 2, powf(a, b)) \
+	X(Min, 2, min(a, b)) \
+	X(Max, 2, max(a, b)) \
+	X(Lt, 2, a < b ? 1.0f : 0.0f) \
+	X(Le, 2, a <= b ? 1.0f : 0.0f) \
+	X(Gt, 2, a > b ? 1.0f : 0.0f) \
+	X(Ge, 2, a >= b ? 1.0f : 0.0f) \
+	X(Eq, 2, a == b ? 1.0f : 0.0f) \
+	X(Ne, 2, a != b ? 1.0f : 0.0f) \
+	X(Neg, 1, -a) \
+	X(Abs, 1, fabsf(a)) \
+	X(Floor, 1, floorf(a)) \
+	X(Fract, 1, a - floorf(a)) \
+	X(Sqrt, 1, sqrtf(a)) \
+	X(Sin, 1, sinf(a)) \
+	X(Cos, 1, cosf(a)) \
+	X(Mix, 3, a + (b - a) * c) \
+	X(Select, 3, a != 0 ? b : c)
+
+enum class ExpressionOp : UINT8 {
+#define X(name, argc, expr) name,
+	EXPRESSION_OPS(X)
+#undef X
+};
+
+// Per-LED expression, compiled once into register based bytecode and evaluated for every LED at once.
+// Registers hold one value per LED (lane) laid out contiguously, inputs first, then constants, then temporaries,
+// so each instruction is a single tight loop over all lanes.
+class Expression {
+	struct Instruction {
+		ExpressionOp op;
+		UINT16 dst, a, b, c;
+	};
+
+	struct Node {
+		enum { Constant, Input, Operation } kind;
+		float value;
+		int input;
+		ExpressionOp op;
+		int args[3];
+	};
+
+	// Compiler state, only used while compiling
+	std::vector<Node> nodes;
+	std::string source;
+	size_t cursor = 0;
+	std::string error;
+	int depth = 0;
+
+	// Program
+	std::vector<Instruction> program;
+	std::vector<float> constants;
+	int registerCount = 0;
+	int result = 0;
+
+	// Register file
+	std::vector<float> registers;
+	int laneCount = 0;
+	int stride = 0;
+
+	int node(ExpressionOp op, int a, int b = -1, int c = -1);
+	int parseTernary();
+	int parseComparison();
+	int parseAdditive();
+	int parseTerm();
+	int parseUnary();
+	int parsePower();
+	int parsePrimary();
+	int parseCall(const std::string& name);
+	void skipSpace();
+	bool accept(const char* token);
+	int fail(const std::string& message);
+
+	int generate(int n, int& top, int& maxTop);
+
+public:
+	bool compile(const std::string& source, std::string& error);
+
+	inline int lanes() const { return laneCount; }
+	void resize(int lanes);
+
+	inline float* input(ExpressionInput in) { return &registers[in * stride]; }
+	inline void set(ExpressionInput in, float value) { std::fill_n(input(in), laneCount, value); }
+
+	// Returns one value per lane, valid until the next call
+	const float* evaluate();
+};
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "LightingEffect.h"
+
+void ExpressionEffect::effect(VisualizerOptions* opt, MeterData* meter) {
+	float gain = opt->gain;
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	float time = (float)fmod(elapsed, EXPRESSION_TIME_WRAP);
+
+	// Do this once per channel
+	for (int c = 0; c < 2; c++) {
+		float level = meter->level[c] * gain;
+		if (opt->hold > 0) {
+			if (level > hold[c]) {
+				hold[c] = level;
+				holdTimer[c] = opt->hold;
+			}
+			else {
+				if (holdTimer[c] <= 0) hold[c] = 0;
+				else {
+					level = hold[c];
+					holdTimer[c] -= 1.0f / opt->frequency;
+				}
+			}
+		}
+
+		if (opt->fall > 0) {
+			level = max(level, last[c] - (opt->fall * gain / opt->frequency));
+			last[c] = level;
+		}
+
+		int lCount = memoryLeds->at(c).size();
+		Expression& expression = expressions[c];
+
+		// Per-LED inputs only change with the LED count
+		if (expression.lanes() != lCount) {
+			expression.resize(lCount);
+			for (int i = 0; i < lCount; i++) {
+				expression.input(EI_Index)[i] = (float)i;
+				expression.input(EI_Position)[i] = lCount > 1 ? (float)i / (lCount - 1) : 0;
+			}
+			expression.set(EI_Count, (float)lCount);
+			expression.set(EI_Zone, (float)c);
+		}
+
+		expression.set(EI_Level, level);
+		expression.set(EI_Low, meter->bands[c][0] * gain);
+		expression.set(EI_Mid, meter->bands[c][1] * gain);
+		expression.set(EI_High, meter->bands[c][2] * gain);
+		expression.set(EI_Time, time);
+		const float* values = expression.evaluate();
+
+		for (int i = 0; i < lCount; i++) {
+			auto led = &memoryLeds->at(c)[lCount - i - 1];
+			float intensity = values[i] > 0 ? min(1, values[i]) : 0; // Also catches NaN
+
+			Color color = opt->multicolor ? opt->colors[i] : opt->colors[0];
+			led->r = (int)(color.r * intensity + opt->background.r * (1 - intensity));
+			led->g = (int)(color.g * intensity + opt->background.g * (1 - intensity));
+			led->b = (int)(color.b * intensity + opt->background.b * (1 - intensity));
+		}
+		CorsairSetLedsColorsBufferByDeviceIndex(devices->at(c).index, memoryLeds->at(c).size(), memoryLeds->at(c).data());
+	}
+
+	CorsairSetLedsColorsFlushBufferAsync(nullptr, nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "AudioSource.h"
+
+// How often the file thread wakes up to read the next chunk
+#define FILE_POLL_MS 5
+
+FileSource::~FileSource() {
+	join();
+}
+
+HRESULT FileSource::open() {
+	file.open(path, std::ios::in | std::ios::binary);
+	if (!file.good()) return E_INVALIDARG;
+
+	char riff[12];
+	if (!file.read(riff, sizeof(riff)) || memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4)) return E_INVALIDARG;
+
+	// Walk the chunks until we find the samples, the format chunk always comes before them
+	std::vector<char> fmt;
+	char header[8];
+	while (file.read(header, sizeof(header))) {
+		UINT32 size = *(UINT32*)(header + 4);
+		std::streampos next = file.tellg() + std::streamoff(size + (size & 1)); // Chunks are padded to even sizes
+
+		if (!memcmp(header, "fmt ", 4)) {
+			fmt.assign(max(size, (UINT32)sizeof(WAVEFORMATEX)), 0);
+			file.read(fmt.data(), size);
+		}
+		else if (!memcmp(header, "data", 4)) {
+			if (fmt.empty()) return E_INVALIDARG;
+
+			HRESULT hr = setFormat((const WAVEFORMATEX*)fmt.data());
+			if (FAILED(hr)) return hr;
+
+			dataStart = file.tellg();
+			dataFrames = size / format.blockAlign;
+			return dataFrames > 0 ? S_OK : E_INVALIDARG;
+		}
+
+		file.seekg(next);
+	}
+
+	return E_INVALIDARG;
+}
+
+// File reader thread
+void FileSource::run(std::atomic_bool* exit) {
+	std::vector<char> buffer;
+	UINT32 position = 0;
+	UINT64 framesPlayed = 0;
+	LARGE_INTEGER frequency, start, now;
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+	file.seekg(dataStart);
+
+	while (!(*exit)) {
+		Sleep(FILE_POLL_MS);
+
+		// Read however much would've played since the last wakeup at the file's own rate
+		QueryPerformanceCounter(&now);
+		UINT64 due = (now.QuadPart - start.QuadPart) * format.sampleRate / frequency.QuadPart;
+		while (framesPlayed < due) {
+			UINT32 frames = (UINT32)min(due - framesPlayed, (UINT64)(dataFrames - position));
+			buffer.resize((size_t)frames * format.blockAlign);
+			file.read(buffer.data(), buffer.size());
+
+			UINT32 framesRead = (UINT32)(file.gcount() / format.blockAlign);
+			write((const BYTE*)buffer.data(), framesRead);
+			framesPlayed += frames;
+			position += frames;
+
+			// Loop back to the start at the end of the file, or if it turned out shorter than the header said
+			if (position >= dataFrames || framesRead < frames) {
+				file.clear();
+				file.seekg(dataStart);
+				position = 0;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "FrameExport.h"
+
+HRESULT FrameExport::open() {
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+
+	mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(SharedFrames), FRAME_EXPORT_NAME);
+	if (!mapping) return HRESULT_FROM_WIN32(GetLastError());
+
+	shared = (SharedFrames*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedFrames));
+	if (!shared) {
+		HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+		close();
+		return hr;
+	}
+
+	// The mapping outlives us while readers hold it, so it may be left over from the last time the graph ran.
+	// In that case carry on numbering frames after the last one published, so latest never goes backwards and
+	// a reader can't take an old frame for a new one. A fresh mapping is all zeros, which would look like frame 0.
+	if (shared->header.magic == FRAME_EXPORT_MAGIC) {
+		UINT64 latest = shared->header.latest.load(std::memory_order_relaxed);
+		frameIndex = latest == FRAME_EXPORT_NONE ? 0 : latest + 1;
+	}
+	else {
+		shared->header.latest.store(FRAME_EXPORT_NONE, std::memory_order_relaxed);
+		frameIndex = 0;
+	}
+
+	// Slot sequences keep counting for the same reason, but a writer that died halfway through a frame leaves
+	// its slot odd, so round those up to the next even value.
+	for (auto& slot : shared->slots) {
+		UINT32 sequence = slot.sequence.load(std::memory_order_relaxed);
+		if (sequence & 1) slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+	}
+	shared->header.slotCount = FRAME_EXPORT_SLOTS;
+	shared->header.slotSize = sizeof(ExportedFrame);
+	shared->header.timestampFrequency = frequency.QuadPart;
+	shared->header.version = FRAME_EXPORT_VERSION;
+	std::atomic_thread_fence(std::memory_order_release);
+	shared->header.magic = FRAME_EXPORT_MAGIC;
+
+	return S_OK;
+}
+
+void FrameExport::close() {
+	if (shared) UnmapViewOfFile(shared);
+	if (mapping) CloseHandle(mapping);
+	shared = nullptr;
+	mapping = NULL;
+}
+
+void FrameExport::publish(const std::vector<CorsairLedArray>& leds, const MeterData& meter) {
+	if (!shared) return;
+
+	ExportedFrame& frame = shared->slots[frameIndex % FRAME_EXPORT_SLOTS];
+	UINT32 sequence = frame.sequence.load(std::memory_order_relaxed);
+
+	// Mark the slot as being written before touching anything in it
+	frame.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	frame.frameIndex = frameIndex;
+	frame.timestamp = now.QuadPart;
+	for (int c = 0; c < 2; c++) {
+		frame.meter.level[c] = meter.level[c];
+		for (int b = 0; b < 3; b++) frame.meter.bands[c][b] = meter.bands[c][b];
+	}
+	for (int c = 0; c < 2; c++) {
+		UINT32 count = c < leds.size() ? (UINT32)min(leds[c].size(), (size_t)FRAME_EXPORT_MAX_LEDS) : 0;
+		frame.ledCount[c] = count;
+		for (UINT32 i = 0; i < count; i++) {
+			const CorsairLedColor& led = leds[c][i];
+			frame.leds[c][i] = { (UINT32)led.ledId, (UINT8)led.r, (UINT8)led.g, (UINT8)led.b, 0 };
+		}
+	}
+
+	frame.sequence.store(sequence + 2, std::memory_order_release);
+	shared->header.latest.store(frameIndex++, std::memory_order_release);
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Utils.h"
+#include "FrameExportLayout.h"
+
+// Writer side, owned by the audio graph thread
+class FrameExport {
+	HANDLE mapping = NULL;
+	SharedFrames* shared = nullptr;
+	UINT64 frameIndex = 0;
+
+public:
+	~FrameExport() { close(); }
+
+	HRESULT open();
+	void close();
+
+	inline bool isOpen() const { return shared != nullptr; }
+	void publish(const std::vector<CorsairLedArray>& leds, const MeterData& meter);
+};
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Every rendered frame is published into a named file mapping so other local tools can see exactly what
+// the modules show without redoing the analysis. Readers open the mapping with OpenFileMapping and
+// MapViewOfFile and read frames in place, the writer never waits for them.
+// This header only depends on the standard library so readers can include it on its own.
+#define FRAME_EXPORT_NAME "Local\\CorsairAudioVisualizer"
+#define FRAME_EXPORT_MAGIC 0x46564143 // "CAVF"
+#define FRAME_EXPORT_VERSION 1
+#define FRAME_EXPORT_SLOTS 8
+#define FRAME_EXPORT_MAX_LEDS 64
+#define FRAME_EXPORT_NONE 0xFFFFFFFFFFFFFFFFull
+
+// Levels the frame was rendered from, same meaning as the MeterData handed to the effects
+struct ExportedLevels {
+	float level[2];
+	float bands[2][3]; // Low, mid and high
+};
+
+struct ExportedLed {
+	uint32_t ledId;
+	uint8_t r, g, b, reserved;
+};
+
+// One slot of the ring, guarded by a seqlock: sequence is odd while the writer is in the middle of it
+struct alignas(64) ExportedFrame {
+	std::atomic<uint32_t> sequence;
+	uint32_t ledCount[2];
+	uint64_t frameIndex;
+	int64_t timestamp; // QueryPerformanceCounter ticks
+	ExportedLevels meter;
+	ExportedLed leds[2][FRAME_EXPORT_MAX_LEDS];
+};
+
+struct alignas(64) ExportHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slotCount;
+	uint32_t slotSize;
+	int64_t timestampFrequency;
+	std::atomic<uint64_t> latest; // Index of the last complete frame, it lives in slot latest % slotCount
+};
+
+struct SharedFrames {
+	ExportHeader header;
+	ExportedFrame slots[FRAME_EXPORT_SLOTS];
+};
+
+// Readers may be built with another compiler or bitness, catch anything that would move a field
+static_assert(sizeof(ExportedFrame) == 1088, "ExportedFrame layout changed, bump FRAME_EXPORT_VERSION");
+static_assert(sizeof(ExportHeader) == 64, "ExportHeader layout changed, bump FRAME_EXPORT_VERSION");
+static_assert(sizeof(SharedFrames) == 64 + FRAME_EXPORT_SLOTS * 1088, "SharedFrames layout changed, bump FRAME_EXPORT_VERSION");
+
+// Reader side: calls consume on the latest frame in place and returns whether it stayed intact while it was
+// being read. Retry on false, the writer lapped the reader or was writing that slot.
+template <class F> bool readLatestFrame(const SharedFrames* shared, F consume) {
+	uint64_t latest = shared->header.latest.load(std::memory_order_acquire);
+	if (latest == FRAME_EXPORT_NONE) return false;
+
+	const ExportedFrame& frame = shared->slots[latest % FRAME_EXPORT_SLOTS];
+	uint32_t before = frame.sequence.load(std::memory_order_acquire);
+	if (before & 1) return false;
+
+	consume(frame);
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return frame.sequence.load(std::memory_order_relaxed) == before;
+}
\ No newline at end of file
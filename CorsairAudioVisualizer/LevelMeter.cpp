@@ -0,0 +1,13 @@
+#include "LevelMeter.h"
+
+void LevelMeter::configure(int sampleRate, float windowMs) {
+	// Callers clamp the window already, this just keeps a bad value from turning into a huge allocation
+	if (!(windowMs >= LEVEL_WINDOW_MIN_MS)) windowMs = LEVEL_WINDOW_MIN_MS;
+	windowMs = min(LEVEL_WINDOW_MAX_MS, windowMs);
+	size_t length = max((size_t)1, (size_t)sampleRate * (size_t)(windowMs * 1000) / 1000000);
+
+	this->windowMs = windowMs;
+	squares.assign(length, 0);
+	sum = 0;
+	pos = 0;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Utils.h"
+
+// Range accepted for the window length
+#define LEVEL_WINDOW_MIN_MS 1.0f
+#define LEVEL_WINDOW_MAX_MS 1000.0f
+
+// Sliding window RMS estimator, keeps a running sum of squared samples over the last windowMs
+// milliseconds so the level doesn't depend on how big the packets WASAPI hands us are
+class LevelMeter {
+	std::vector<float> squares; // Circular buffer of squared samples
+	double sum = 0;
+	size_t pos = 0;
+	float windowMs = 0;
+
+public:
+	void configure(int sampleRate, float windowMs);
+	inline float window() const { return windowMs; }
+
+	inline void push(float sample) {
+		float sq = sample * sample;
+		sum += sq - squares[pos];
+		squares[pos] = sq;
+
+		// Recompute the sum from scratch once per lap so rounding errors can't pile up
+		if (++pos == squares.size()) {
+			pos = 0;
+			sum = 0;
+			for (float s : squares) sum += s;
+		}
+	}
+
+	inline float rms() const {
+		return sqrtf((float)max(0.0, sum / squares.size()));
+	}
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Utils.h"
+#include "Expression.h"
 
 class AudioLightingEffect {
 protected:
@@ -20,7 +21,11 @@ public:
 		: memoryLeds(other.memoryLeds), devices(other.devices)
 	{ }
 
-	virtual void effect(VisualizerOptions*, UINT32, float*) = 0;
+	virtual ~AudioLightingEffect() { }
+
+	inline const std::vector<CorsairLedArray>* leds() const { return memoryLeds; }
+
+	virtual void effect(VisualizerOptions*, MeterData*) = 0;
 	inline virtual const char* name() = 0;
 };
 
@@ -36,7 +41,7 @@ public:
 		: AudioLightingEffect(other)
 	{ }
 
-	void effect(VisualizerOptions*, UINT32, float*);
+	void effect(VisualizerOptions*, MeterData*);
 	inline const char* name() { return BarsEffect::Name; }
 };
 
@@ -52,7 +57,7 @@ public:
 		: AudioLightingEffect(other)
 	{ }
 
-	void effect(VisualizerOptions*, UINT32, float*);
+	void effect(VisualizerOptions*, MeterData*);
 	inline const char* name() { return PulseEffect::Name; }
 };
 
@@ -68,6 +73,25 @@ public:
 		: AudioLightingEffect(other)
 	{ }
 
-	void effect(VisualizerOptions*, UINT32, float*);
+	void effect(VisualizerOptions*, MeterData*);
 	inline const char* name() { return DoubleBarsEffect::Name; }
+};
+
+// Effect defined by a per-LED expression, evaluated for every LED of a module at once
+class ExpressionEffect : public AudioLightingEffect {
+	Expression expressions[2];
+	std::string definition;
+	std::chrono::steady_clock::time_point start;
+
+public:
+	static constexpr const char* Name = "expr";
+
+	ExpressionEffect(const AudioLightingEffect& other, const Expression& expression, const std::string& source)
+		: AudioLightingEffect(other), expressions{ expression, expression },
+		definition(std::string(Name) + " " + source), start(std::chrono::steady_clock::now())
+	{ }
+
+	void effect(VisualizerOptions*, MeterData*);
+	// Includes the expression so saved profiles can recreate the effect
+	inline const char* name() { return definition.c_str(); }
 };
\ No newline at end of file
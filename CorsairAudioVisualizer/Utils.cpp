@@ -49,6 +49,19 @@ const char* crsDevTypeToString(CorsairDeviceType devType) {
 	}
 }
 
+const char* sourceTypeToString(SourceType type) {
+	switch (type) {
+	case SourceType::Output:
+		return "output";
+	case SourceType::Input:
+		return "input";
+	case SourceType::File:
+		return "file";
+	default:
+		return "none";
+	}
+}
+
 int saveProfile(VisualizerOptions& opt, const char* name) {
 	if (std::filesystem::exists(name)) {
 		std::string answer;
@@ -68,8 +81,22 @@ int saveProfile(VisualizerOptions& opt, const char* name) {
 	file << "gain " << opt.gain << std::endl;
 	file << "fall " << opt.fall << std::endl;
 	file << "hold " << opt.hold << std::endl;
+	file << "window " << opt.window << std::endl;
 	file << "frequency " << opt.frequency << std::endl;
 	file << "multicolor " << (opt.multicolor ? "true" : "false") << std::endl;
+	file << "export " << (opt.exportFrames ? "true" : "false") << std::endl;
+	file << "sources " << opt.sources.size() << std::endl;
+	for (int i = 0; i < opt.sources.size(); i++) {
+		file << "source " << i << " " << sourceTypeToString(opt.sources[i].type);
+		if (!opt.sources[i].target.empty()) file << " " << opt.sources[i].target;
+		file << std::endl;
+	}
+	for (int c = 0; c < 2; c++) {
+		file << "route " << c;
+		if (opt.routes[c].empty()) file << " none";
+		for (auto& tap : opt.routes[c]) file << " " << tap.source << ":" << tap.channel << "*" << tap.gain;
+		file << std::endl;
+	}
 	file << "effect " << opt.effect->name();
 }
 
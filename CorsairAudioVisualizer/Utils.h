@@ -25,6 +25,33 @@ struct Color {
 	int b;
 };
 
+enum class SourceType { None, Output, Input, File };
+
+// An input of the audio graph, target is an endpoint ID or a file path (empty for the default endpoint)
+struct SourceConfig {
+	SourceType type;
+	std::string target;
+
+	inline bool operator==(const SourceConfig& other) const { return type == other.type && target == other.target; }
+};
+
+// A source channel mixed into one of the effect inputs
+struct RouteTap {
+	int source;
+	int channel;
+	float gain;
+
+	inline bool operator==(const RouteTap& other) const {
+		return source == other.source && channel == other.channel && gain == other.gain;
+	}
+};
+
+// Per-channel levels handed to the lighting effects on every update
+struct MeterData {
+	float level[2];
+	float bands[2][3]; // Low, mid and high
+};
+
 class AudioLightingEffect;
 struct VisualizerOptions {
 	AudioLightingEffect* effect;
@@ -33,13 +60,20 @@ struct VisualizerOptions {
 	float gain;
 	float fall;
 	float hold;
+	float window;
 	int frequency;
 	bool smooth;
 	bool multicolor;
+	bool exportFrames;
+	// Read by the graph thread when it starts, only touch with graphMutex held
+	std::vector<SourceConfig> sources;
+	std::vector<RouteTap> routes[2];
+	std::mutex graphMutex;
 };
 
 const char* crsErrorToString(CorsairError error);
 const char* crsDevTypeToString(CorsairDeviceType devType);
+const char* sourceTypeToString(SourceType type);
 int saveProfile(VisualizerOptions& opt, const char* name);
 
 // Define a unary operation to get a filename (leaf) string from a path object